@@ -0,0 +1,247 @@
+// Batch position analysis for agent_200
+/*
+ * Streams concatenated positions in the referee's format (player to move, then the board
+ * from the top row down) from a file or stdin and answers every one as agent_200 would,
+ * without the opening book: a win proven by the threat-space pre-pass, an exact solve with
+ * few empty cells, iterative deepening otherwise. Positions are handed out to worker threads that share the transposition
+ * table, so it stays warm from one position to the next (it is aged once per BATCH_CHUNK
+ * positions, not once per search). One line per position, in input order:
+ *
+ *   position=<index> move=<A-G or -> score=<n> depth=<n> nodes=<n> ms=<t>
+ *
+ * score is from the side to move: a heuristic score, or +-WDL_DB_SCORE / 0 for a solved or
+ * proven position, whose depth is then the number of empty cells. Finished positions get
+ * move=-. With -c, the built-in check positions are answered instead (see below).
+ *
+ * Usage: ./batch [-c] [-d depth] [-t threads] [-e endgame_empty] [file]
+ */
+
+#define AGENT_200_NO_MAIN
+#define AGENT_NODE_COUNT
+#include "agent_200.c"
+
+#include <getopt.h>
+
+#define BATCH_CHUNK 1024            // Positions per transposition table generation
+
+typedef struct {
+    int ready;
+    int move;
+    int score;
+    int depth;
+    uint64_t nodes;
+    double ms;
+} BatchResult;
+
+// Input and output are shared by the workers under one lock
+static pthread_mutex_t batch_lock = PTHREAD_MUTEX_INITIALIZER;
+static FILE* batch_in;
+static int batch_done = 0;          // Input exhausted (or malformed)
+static int batch_failed = 0;
+static int batch_read = 0;          // Positions handed out
+static int batch_printed = 0;       // Positions written, in input order
+static BatchResult* batch_results = NULL;
+static int batch_capacity = 0;
+
+static void batch_answer(State* s, BatchResult* r) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    thread_nodes = 0;
+    r->move = -1;
+    r->score = 0;
+    r->depth = 0;
+    int moves[COLS];
+    if (check_winner(s) == 0 && get_valid_moves(s, moves) > 0) {
+        int empty = BOARD_CELLS - s->moves;
+        r->move = threat_search(s);
+        if (r->move >= 0) {
+            r->score = WDL_DB_SCORE;
+            r->depth = empty;
+        }
+        if (r->move < 0 && empty <= endgame_empty_cells) {
+            int wdl;
+            r->move = endgame_solve_value(s, &wdl);
+            r->score = wdl * WDL_DB_SCORE;
+            r->depth = empty;
+        }
+        if (r->move < 0) {
+            SearchResult result;
+            r->move = iterative_search_result(s, search_depth, s->player, -1, &result);
+            r->score = result.value;
+            r->depth = result.depth;
+        }
+    }
+    r->nodes = thread_nodes;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    r->ms = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    r->ready = 1;
+}
+
+// Self-check (-c): positions whose right answers are known. Each one is answered as
+// configured, then by the search alone (no threat pre-pass, no exact solver).
+typedef struct {
+    const char* name;
+    const char* position;   // Referee's format
+    const char* moves;      // Right answers
+} BatchCheck;
+
+static const BatchCheck batch_checks[] = {
+    { "win at once while threatened",
+      "1\n0 0 0 0 0 0 0\n0 0 0 0 0 0 0\n0 0 0 0 0 0 0\n1 0 0 0 0 0 2\n1 0 0 0 0 0 2\n1 0 0 0 0 0 2\n", "A" },
+    { "block the only threat",
+      "1\n0 0 0 0 0 0 0\n0 0 0 0 0 0 0\n0 0 0 0 0 0 0\n0 0 0 0 0 0 2\n0 0 0 0 0 0 2\n1 0 1 0 1 0 2\n", "G" },
+    { "open three on the bottom row",
+      "1\n0 0 0 0 0 0 0\n0 0 0 0 0 0 0\n0 0 0 0 0 0 0\n0 0 0 0 0 0 0\n0 0 2 2 0 0 0\n0 0 1 1 0 0 0\n", "BE" },
+};
+
+// Returns the number of wrong answers
+static int batch_check(void) {
+    int configured_threat_nodes = threat_nodes;
+    int configured_empty_cells = endgame_empty_cells;
+    int failures = 0;
+    for (size_t i = 0; i < sizeof(batch_checks) / sizeof(batch_checks[0]); i++) {
+        const BatchCheck* c = &batch_checks[i];
+        for (int alone = 0; alone <= 1; alone++) {
+            threat_nodes = alone ? 0 : configured_threat_nodes;
+            endgame_empty_cells = alone ? 0 : configured_empty_cells;
+            State s;
+            FILE* in = fmemopen((void*)c->position, strlen(c->position), "r");
+            if (in == NULL || read_position(in, &s) != 1) {
+                fprintf(stderr, "Error: malformed check position \"%s\"\n", c->name);
+                exit(EXIT_FAILURE);
+            }
+            fclose(in);
+            BatchResult r;
+            batch_answer(&s, &r);
+            int ok = r.move >= 0 && strchr(c->moves, stack_name(r.move)) != NULL;
+            if (!ok) failures++;
+            printf("check %-30s %-6s move=%c score=%d  %s\n", c->name, alone ? "search" : "full",
+                   r.move >= 0 ? stack_name(r.move) : '-', r.score, ok ? "ok" : "WRONG");
+        }
+    }
+    threat_nodes = configured_threat_nodes;
+    endgame_empty_cells = configured_empty_cells;
+    return failures;
+}
+
+static void* batch_worker(void* arg) {
+    (void)arg;
+    for (;;) {
+        State s;
+        pthread_mutex_lock(&batch_lock);
+        int status = batch_done ? 0 : read_position(batch_in, &s);
+        if (status <= 0) {
+            batch_done = 1;
+            if (status < 0) batch_failed = 1;
+            pthread_mutex_unlock(&batch_lock);
+            break;
+        }
+        int index = batch_read++;
+        // Entries of the previous chunk are replaced first, those of this one stay warm
+        if (index % BATCH_CHUNK == 0) tt_new_search();
+        pthread_mutex_unlock(&batch_lock);
+
+        BatchResult r;
+        batch_answer(&s, &r);
+
+        pthread_mutex_lock(&batch_lock);
+        if (index >= batch_capacity) {
+            int capacity = batch_capacity ? 2 * batch_capacity : 1024;
+            while (capacity <= index) capacity *= 2;
+            BatchResult* grown = realloc(batch_results, capacity * sizeof(BatchResult));
+            if (grown == NULL) {
+                fprintf(stderr, "Error: out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            memset(grown + batch_capacity, 0, (capacity - batch_capacity) * sizeof(BatchResult));
+            batch_results = grown;
+            batch_capacity = capacity;
+        }
+        batch_results[index] = r;
+        while (batch_printed < batch_capacity && batch_results[batch_printed].ready) {
+            const BatchResult* p = &batch_results[batch_printed];
+            printf("position=%d move=%c score=%d depth=%d nodes=%llu ms=%.1f\n", batch_printed,
+                   p->move >= 0 ? stack_name(p->move) : '-', p->score, p->depth,
+                   (unsigned long long)p->nodes, p->ms);
+            batch_printed++;
+        }
+        fflush(stdout);
+        pthread_mutex_unlock(&batch_lock);
+    }
+    solver_free();          // Thread-local: lost when the thread exits
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int num_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+    int check = 0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "cd:t:e:")) != -1) {
+        switch (opt) {
+            case 'c': check = 1; break;
+            case 'd': search_depth = atoi(optarg); break;
+            case 't': num_threads = atoi(optarg); break;
+            case 'e': endgame_empty_cells = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-c] [-d depth] [-t threads] [-e endgame_empty] [file]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (search_depth < 1 || num_threads < 1) {
+        fprintf(stderr, "Error: invalid depth or thread count\n");
+        return EXIT_FAILURE;
+    }
+    batch_in = stdin;
+    if (optind < argc) {
+        batch_in = fopen(argv[optind], "r");
+        if (batch_in == NULL) {
+            fprintf(stderr, "Error: cannot open %s\n", argv[optind]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Evaluate as the agent does; each position is searched on one thread
+    const char* nn_env = getenv("AGENT_NN");
+    nn_load(nn_env != NULL ? nn_env : NN_FILE);
+    if (nn_loaded) {
+        futility_margin = NN_FUTILITY_MARGIN;
+    }
+    const char* wdl_env = getenv("AGENT_WDL_DB");
+    table_open(&wdl_db, wdl_env != NULL ? wdl_env : WDL_DB_FILE, WDL_DB_MAGIC);
+    const char* threat_env = getenv("AGENT_THREAT_NODES");
+    if (threat_env != NULL) {
+        threat_nodes = atoi(threat_env);
+    }
+    const char* tb_env = getenv("AGENT_TB");
+    tb_open(&endgame_tb, tb_env != NULL ? tb_env : TB_FILE);
+    search_threads = 1;
+    tt_age_per_search = 0;
+    if (tt_init() != 0) {
+        fprintf(stderr, "Error: out of memory\n");
+        return EXIT_FAILURE;
+    }
+    if (check) {
+        int failures = batch_check();
+        solver_free();
+        tt_free();
+        return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    pthread_t* workers = malloc(num_threads * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&workers[started], NULL, batch_worker, NULL) != 0) break;
+        started++;
+    }
+    batch_worker(NULL);     // The main thread works as well
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+    tt_free();
+    free(batch_results);
+    if (batch_in != stdin) fclose(batch_in);
+    return batch_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,103 @@
+// Bitboards shared by the agents
+/*
+ * Board layout, threat masks and the player-to-move Position used by agent_200, the
+ * rollout engine (and through it the MCTS agent) and the greedy agents. Include it after
+ * defining COLS and ROWS if the board is not 7 x 6. Everything is static inline, so
+ * including files only pay for what they use.
+ */
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <stdint.h>
+
+#ifndef COLS
+#define COLS 7
+#endif
+#ifndef ROWS
+#define ROWS 6
+#endif
+#define BOARD_CELLS (ROWS * COLS)
+
+// Cell (row, col) is bit col * (ROWS + 1) + row, row 0 being the bottom.
+// The extra bit on top of each column is always empty, so shifted lines never wrap.
+#define COL_BITS (ROWS + 1)
+#define CELL_BIT(row, col) (1ULL << ((col) * COL_BITS + (row)))
+
+static const uint64_t BOTTOM_MASK = 0x40810204081ULL;             // Bottom cell of every column
+static const uint64_t BOARD_MASK = 0x40810204081ULL * 0x3fULL;    // Every playable cell
+
+// Position from the point of view of the player to move
+typedef struct {
+    uint64_t current;   // Stones of the player to move
+    uint64_t mask;      // All stones
+    int moves;
+} Position;
+
+static inline uint64_t column_mask(int col) {
+    return ((1ULL << ROWS) - 1) << (col * COL_BITS);
+}
+
+static inline uint64_t bottom_cell(int col) {
+    return 1ULL << (col * COL_BITS);
+}
+
+static inline int popcount64(uint64_t x) {
+    return __builtin_popcountll(x);
+}
+
+// Cells where a stone can be dropped right now (one per non-full column)
+static inline uint64_t playable_cells(uint64_t mask) {
+    return (mask + BOTTOM_MASK) & BOARD_MASK;
+}
+
+// Empty cells that would complete four in a row for the owner of stones
+static inline uint64_t winning_cells(uint64_t stones, uint64_t mask) {
+    // Vertical
+    uint64_t r = (stones << 1) & (stones << 2) & (stones << 3);
+
+    // Horizontal, then the two diagonals (shift by COL_BITS, COL_BITS - 1, COL_BITS + 1)
+    const int shifts[3] = { COL_BITS, COL_BITS - 1, COL_BITS + 1 };
+    for (int k = 0; k < 3; k++) {
+        int d = shifts[k];
+        uint64_t p = (stones << d) & (stones << 2 * d);
+        r |= p & (stones << 3 * d);
+        r |= p & (stones >> d);
+        p = (stones >> d) & (stones >> 2 * d);
+        r |= p & (stones << d);
+        r |= p & (stones >> 3 * d);
+    }
+    return r & (BOARD_MASK ^ mask);
+}
+
+// Does the owner of stones have four in a row?
+static inline int has_four(uint64_t stones) {
+    const int shifts[4] = { 1, COL_BITS, COL_BITS - 1, COL_BITS + 1 };
+    for (int k = 0; k < 4; k++) {
+        uint64_t pairs = stones & (stones >> shifts[k]);
+        if (pairs & (pairs >> 2 * shifts[k])) return 1;
+    }
+    return 0;
+}
+
+// Cells the owner of stones (to move) can play without handing the opponent an immediate
+// win: a single forced block is played, two threats cannot both be blocked (0 is returned),
+// and cells right under an opponent's winning cell are avoided.
+static inline uint64_t non_losing_cells(uint64_t stones, uint64_t mask) {
+    uint64_t possible = playable_cells(mask);
+    uint64_t opponent_win = winning_cells(stones ^ mask, mask);
+    uint64_t forced = possible & opponent_win;
+    if (forced) {
+        if (forced & (forced - 1)) return 0;
+        possible = forced;
+    }
+    return possible & ~(opponent_win >> 1);
+}
+
+static inline void position_play(Position* p, uint64_t move_bit) {
+    p->current ^= p->mask;
+    p->mask |= move_bit;
+    p->moves++;
+}
+
+#endif
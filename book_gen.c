@@ -0,0 +1,86 @@
+// Opening book generator for agent_200
+/*
+ * Enumerates every position reachable within the first N plies (mirror images merged),
+ * picks a move for each one and writes them as a sorted table that agent_200 maps at startup.
+ * Positions with few empty cells are solved exactly; the others get a deep alpha-beta search,
+ * or an exact solve with -s (slow for the very first plies).
+ *
+ * Usage: ./book_gen [-p plies] [-d depth] [-s] [-o output]
+ */
+
+#define AGENT_200_NO_MAIN
+#include "agent_200.c"
+#include "position_set.h"
+
+#include <getopt.h>
+
+int main(int argc, char* argv[]) {
+    int plies = 4;
+    int depth = 8;
+    int solve_all = 0;
+    const char* output = BOOK_FILE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "p:d:so:")) != -1) {
+        switch (opt) {
+            case 'p': plies = atoi(optarg); break;
+            case 'd': depth = atoi(optarg); break;
+            case 's': solve_all = 1; break;
+            case 'o': output = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-p plies] [-d depth] [-s] [-o output]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (plies < 0 || depth < 1) {
+        fprintf(stderr, "Error: invalid plies or depth\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t* entries = NULL;
+    size_t num_entries = 0;
+    Position empty = { 0, 0, 0 };
+    PositionNode* level = malloc(sizeof(PositionNode));
+    level[0] = make_node(&empty);
+    size_t count = 1;
+
+    for (int ply = 0; ply <= plies && count > 0; ply++) {
+        entries = realloc(entries, (num_entries + count) * sizeof(uint64_t));
+        if (entries == NULL) {
+            fprintf(stderr, "Error: out of memory\n");
+            return EXIT_FAILURE;
+        }
+        for (size_t i = 0; i < count; i++) {
+            State s;
+            state_from_position(&level[i].pos, &s);
+            int move, wdl = -2;
+            if (solve_all || BOARD_CELLS - s.moves <= endgame_empty_cells) {
+                move = endgame_solve(&s);
+                if (move >= 0) {
+                    State child;
+                    copy_state(&s, &child);
+                    apply_move(&child, move);
+                    Position cp = { child.stones[child.player], child.mask, child.moves };
+                    wdl = (check_winner(&child) == s.player) ? 1
+                        : (child.moves == BOARD_CELLS) ? 0 : -solver_wdl(&cp);
+                }
+            } else {
+                move = alphabeta_search(&s, depth, s.player);
+            }
+            if (move < 0) continue;
+            entries[num_entries++] = (level[i].key << 8) | BOOK_PAYLOAD(move, wdl);
+        }
+        fprintf(stderr, "ply %d: %zu positions\n", ply, count);
+
+        if (ply < plies) count = advance_level(&level, count);
+    }
+    free(level);
+
+    if (table_write(output, BOOK_MAGIC, entries, num_entries) != 0) {
+        perror("Error: failed to write book");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Wrote %zu entries to %s\n", num_entries, output);
+    free(entries);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,96 @@
+// Pieces shared by the greedy agents (team_208_agent.c and upgrade_agent/agent.c)
+/*
+ * The anytime fallback: the move is written exactly once, either by main through
+ * write_move or by the SIGALRM handler when TIME_LIMIT_MS is reached. SIGALRM is blocked
+ * while main writes, and the handler only uses write() and _exit(), which are
+ * async-signal-safe. The handler plays the most central column that is not full
+ * according to the bitboard mask given to start_timer.
+ *
+ * The threat filter: wins the bitboard confirms, and the moves that do not let the
+ * opponent win at once (see non_losing_cells in bitboard.h).
+ */
+
+#ifndef GREEDY_AGENT_H
+#define GREEDY_AGENT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include "bitboard.h"
+
+#ifndef TIME_LIMIT_MS
+#define TIME_LIMIT_MS 2700 // The referee allows 3 s per move
+#endif
+
+// -------------------------
+// Anytime fallback
+// -------------------------
+
+static volatile sig_atomic_t move_written = 0;
+static uint64_t timer_mask;   // All stones, set before the timer starts
+
+static inline void write_move(int col) {
+    sigset_t alarm_set, old_set;
+    sigemptyset(&alarm_set);
+    sigaddset(&alarm_set, SIGALRM);
+    sigprocmask(SIG_BLOCK, &alarm_set, &old_set);
+    if (!move_written) {
+        move_written = 1;
+        printf("%c", 'A' + col);
+        fflush(stdout);
+    }
+    sigprocmask(SIG_SETMASK, &old_set, NULL);
+}
+
+static inline void timeout_handler(int sig) {
+    static const int order[COLS] = { 3, 2, 4, 1, 5, 0, 6 };
+    uint64_t playable = playable_cells(timer_mask);
+    (void)sig;
+    for (int k = 0; k < COLS && !move_written; k++) {
+        if (playable & column_mask(order[k])) {
+            char c = 'A' + order[k];
+            move_written = 1;
+            if (write(STDOUT_FILENO, &c, 1) != 1) break;
+        }
+    }
+    _exit(EXIT_SUCCESS);
+}
+
+static inline void start_timer(uint64_t mask) {
+    struct itimerval timer = { { 0, 0 }, { TIME_LIMIT_MS / 1000, (TIME_LIMIT_MS % 1000) * 1000 } };
+    timer_mask = mask;
+    signal(SIGALRM, timeout_handler);
+    setitimer(ITIMER_REAL, &timer, NULL);
+}
+
+// -------------------------
+// Threat filter
+// -------------------------
+
+typedef struct {
+    uint64_t wins;   // Playable cells that win at once
+    uint64_t safe;   // Moves that do not lose at once, 0 when every move loses
+} Threats;
+
+static inline Threats threats_of(uint64_t stones, uint64_t mask) {
+    Threats t = { winning_cells(stones, mask) & playable_cells(mask), non_losing_cells(stones, mask) };
+    return t;
+}
+
+// Column to win with: hint if it really wins, otherwise any winning column, or -1
+static inline int threat_win_column(const Threats* t, int hint) {
+    if (hint >= 0 && (t->wins & column_mask(hint))) return hint;
+    for (int col = 0; col < COLS; col++) {
+        if (t->wins & column_mask(col)) return col;
+    }
+    return -1;
+}
+
+// Moves outside safe are left out, unless every move loses
+static inline int threat_allows(const Threats* t, int col) {
+    return !t->safe || (t->safe & column_mask(col));
+}
+
+#endif
@@ -0,0 +1,367 @@
+// Monte Carlo Tree Search agent (used for both AgentX and AgentY)
+/*
+ * A structurally different opponent for agent_200: UCT (or PUCT with a center prior)
+ * over bitboards with playouts from rollout.h.
+ * - Tree nodes come from one arena, bump-allocated; there is no malloc per node.
+ * - The children of a node are allocated together, so they sit next to each other in memory.
+ * - The search runs until the per-move deadline and reports playouts per second on stderr.
+ * - Several threads search at once, either sharing one tree (tree parallelism: virtual loss,
+ *   atomic statistics, lock-free expansion) or growing one tree each and merging the root
+ *   statistics at the end (root parallelism).
+ *
+ * Environment: MCTS_TIME_MS (time per move, default 2500), MCTS_PUCT=1 (PUCT selection),
+ *              MCTS_THREADS (default 4), MCTS_PARALLEL=tree|root (default tree)
+ */
+
+// Libraries
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/mman.h>
+
+// Define constants
+#define COLS 7
+#define ROWS 6
+#include "rollout.h"                // Bitboards, per-thread xorshift and playouts
+#ifndef MCTS_TIME_MS
+#define MCTS_TIME_MS 2500           // Default time per move; the referee allows 3 seconds
+#endif
+#ifndef MCTS_ARENA_NODES
+#define MCTS_ARENA_NODES (1u << 23) // Arena capacity in nodes (16 bytes each)
+#endif
+#ifndef MCTS_THREADS
+#define MCTS_THREADS 4              // Default number of search threads
+#endif
+#define MAX_THREADS 64
+#define VIRTUAL_LOSS 1              // Visits a thread adds on the way down, before its result is known
+#define UCT_C 1.4                   // Exploration constant for UCT
+#define PUCT_C 2.0                  // Exploration constant for PUCT
+
+// -------------------------
+// Search Tree
+// -------------------------
+// Statistics are kept from the point of view of the player who made the node's move.
+// visits and score are updated with relaxed atomics; first_child publishes the children:
+// 0 = leaf, NODE_EXPANDING = another thread is creating them, otherwise the first index.
+#define NODE_OPEN 0
+#define NODE_WIN 1      // The move wins the game
+#define NODE_DRAW 2     // The move fills the board
+#define NODE_EXPANDING UINT32_MAX
+
+typedef struct {
+    _Atomic uint32_t first_child;   // Arena index of the first child, see above
+    uint8_t num_children;
+    uint8_t move;           // Column played to reach this node
+    uint8_t terminal;       // NODE_OPEN, NODE_WIN or NODE_DRAW
+    uint8_t prior;          // PUCT prior in 1/16ths
+    _Atomic uint32_t visits;        // Includes virtual losses of threads still below this node
+    _Atomic uint32_t score;         // Sum of results in half points (win 2, draw 1)
+} Node;
+
+// Bump allocator: nodes are never freed individually, the whole arena goes with the process
+typedef struct {
+    Node* nodes;
+    _Atomic uint32_t used;
+    uint32_t capacity;
+} Arena;
+
+static Arena arena;
+static int use_puct = 0;
+
+// Center columns take part in more lines, so PUCT tries them first
+static const uint8_t column_prior[COLS] = { 1, 2, 3, 4, 3, 2, 1 };
+
+static inline uint32_t load_relaxed(_Atomic uint32_t* x) {
+    return atomic_load_explicit(x, memory_order_relaxed);
+}
+
+static inline void add_relaxed(_Atomic uint32_t* x, uint32_t v) {
+    atomic_fetch_add_explicit(x, v, memory_order_relaxed);
+}
+
+static int arena_init(uint32_t capacity) {
+    // Anonymous mapping: pages are only backed once the tree grows into them
+    void* mem = mmap(NULL, (size_t)capacity * sizeof(Node), PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED) return -1;
+    arena.nodes = mem;
+    atomic_init(&arena.used, 1);    // Index 0 is reserved so that first_child == 0 means "no children"
+    arena.capacity = capacity;
+    return 0;
+}
+
+// Reserve n consecutive nodes; returns the first index or 0 when the arena is full
+static uint32_t arena_alloc(uint32_t n) {
+    if (load_relaxed(&arena.used) + n > arena.capacity) return 0;     // Keeps used from wrapping
+    uint32_t first = atomic_fetch_add_explicit(&arena.used, n, memory_order_relaxed);
+    if (first + n > arena.capacity) return 0;
+    return first;
+}
+
+static uint32_t new_root(void) {
+    uint32_t index = arena_alloc(1);
+    if (index != 0) memset(&arena.nodes[index], 0, sizeof(Node));
+    return index;
+}
+
+// Create the children of node for position p (the position reached by node's move).
+// Only the thread that wins the race from 0 to NODE_EXPANDING builds them; returns 1 if
+// the node has children afterwards.
+static int expand(Node* node, const Position* p) {
+    uint32_t expected = 0;
+    if (!atomic_compare_exchange_strong(&node->first_child, &expected, NODE_EXPANDING)) {
+        return expected != NODE_EXPANDING;
+    }
+    uint64_t possible = playable_cells(p->mask);
+    uint64_t win = winning_cells(p->current, p->mask);
+    // Without a win at hand, moves that let the opponent win at once are not worth a child
+    if (!(possible & win)) {
+        uint64_t safe = non_losing_cells(p->current, p->mask);
+        if (safe) possible = safe;
+    }
+    int n = 0;
+    for (int col = 0; col < COLS; col++) {
+        if (possible & column_mask(col)) n++;
+    }
+    uint32_t first = arena_alloc(n);
+    if (first == 0) {
+        // Out of memory: leave the node as a leaf that is always played out
+        atomic_store_explicit(&node->first_child, NODE_EXPANDING, memory_order_relaxed);
+        return 0;
+    }
+
+    Node* child = &arena.nodes[first];
+    for (int col = 0; col < COLS; col++) {
+        uint64_t move = possible & column_mask(col);
+        if (!move) continue;
+        memset(child, 0, sizeof(Node));
+        child->move = col;
+        child->prior = column_prior[col];
+        if (move & win) child->terminal = NODE_WIN;
+        else if (p->moves + 1 == BOARD_CELLS) child->terminal = NODE_DRAW;
+        child++;
+    }
+    node->num_children = n;
+    atomic_store_explicit(&node->first_child, first, memory_order_release);
+    return 1;
+}
+
+// Pick the child to descend into
+static Node* select_child(Node* node, uint32_t first_child) {
+    Node* children = &arena.nodes[first_child];
+    uint32_t parent_visits = load_relaxed(&node->visits);
+    double log_n = log((double)parent_visits + 1);
+    double sqrt_n = sqrt((double)parent_visits + 1);
+    int prior_sum = 0;
+    for (int i = 0; i < node->num_children; i++) prior_sum += children[i].prior;
+
+    Node* best = NULL;
+    double best_value = -1.0;
+    for (int i = 0; i < node->num_children; i++) {
+        Node* c = &children[i];
+        uint32_t visits = load_relaxed(&c->visits);
+        double q = visits ? load_relaxed(&c->score) / (2.0 * visits) : 0.5;
+        double value;
+        if (use_puct) {
+            double prior = (double)c->prior / prior_sum;
+            value = q + PUCT_C * prior * sqrt_n / (1 + visits);
+        } else {
+            if (visits == 0) return c;
+            value = q + UCT_C * sqrt(log_n / visits);
+        }
+        if (value > best_value) {
+            best_value = value;
+            best = c;
+        }
+    }
+    return best;
+}
+
+// One iteration: select, expand, play out and back up.
+// Every node on the way down takes a virtual loss so other threads spread out.
+static void mcts_iteration(Node* root, const Position* root_pos) {
+    Node* path[BOARD_CELLS + 1];
+    int depth = 0;
+    Position p = *root_pos;
+    Node* node = root;
+    add_relaxed(&node->visits, VIRTUAL_LOSS);
+    path[depth++] = node;
+
+    while (node->terminal == NODE_OPEN) {
+        uint32_t first = atomic_load_explicit(&node->first_child, memory_order_acquire);
+        if (first == NODE_EXPANDING) break;         // Being expanded elsewhere: play out from here
+        if (first == 0) {
+            if (load_relaxed(&node->visits) <= VIRTUAL_LOSS && node != root) break;   // Play out a fresh leaf first
+            if (!expand(node, &p)) break;
+            first = atomic_load_explicit(&node->first_child, memory_order_acquire);
+        }
+        node = select_child(node, first);
+        position_play(&p, playable_cells(p.mask) & column_mask(node->move));
+        add_relaxed(&node->visits, VIRTUAL_LOSS);
+        path[depth++] = node;
+    }
+
+    // Result for the player who made the last move on the path
+    int reward;
+    if (node->terminal == NODE_WIN) reward = 2;
+    else if (node->terminal == NODE_DRAW) reward = 1;
+    else reward = 2 - rollout(p);
+
+    // The visit was counted on the way down; drop the extra virtual losses and add the result
+    for (int i = depth - 1; i >= 0; i--) {
+        if (VIRTUAL_LOSS > 1) atomic_fetch_sub_explicit(&path[i]->visits, VIRTUAL_LOSS - 1, memory_order_relaxed);
+        add_relaxed(&path[i]->score, reward);
+        reward = 2 - reward;
+    }
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Work for one search thread
+typedef struct {
+    Node* root;
+    const Position* root_pos;
+    double deadline;
+    uint64_t seed;
+    uint64_t playouts;      // Output
+} SearchThread;
+
+static void* search_thread(void* arg) {
+    SearchThread* t = (SearchThread*)arg;
+    rng_seed(t->seed);
+    uint64_t playouts = 0;
+    do {
+        for (int i = 0; i < 256; i++) {
+            mcts_iteration(t->root, t->root_pos);
+        }
+        playouts += 256;
+    } while (now_seconds() < t->deadline);
+    t->playouts = playouts;
+    return NULL;
+}
+
+// Stack name conversion
+char stack_name(int i) {
+    return 'A' + i;
+}
+
+int main() {
+    double start = now_seconds();
+    int this_player;
+    if (scanf("%d", &this_player) != 1) {
+        fprintf(stderr, "Error: Failed to read player number\n");
+        return EXIT_FAILURE;
+    }
+    if (this_player != 1 && this_player != 2) {
+        fprintf(stderr, "Error: Invalid player number %d\n", this_player);
+        return EXIT_FAILURE;
+    }
+
+    // Read board: the first line is the top row
+    Position root_pos = { 0, 0, 0 };
+    for (int i = ROWS - 1; i >= 0; i--) {
+        for (int j = 0; j < COLS; j++) {
+            int value;
+            if (scanf("%d", &value) != 1) {
+                fprintf(stderr, "Error: Failed to read board at position [%d][%d]\n", ROWS - 1 - i, j);
+                return EXIT_FAILURE;
+            }
+            if (value == 0) continue;
+            if (value == this_player) root_pos.current |= CELL_BIT(i, j);
+            root_pos.mask |= CELL_BIT(i, j);
+            root_pos.moves++;
+        }
+    }
+    if (playable_cells(root_pos.mask) == 0) {
+        fprintf(stderr, "Error: No valid move found\n");
+        return EXIT_FAILURE;
+    }
+
+    const char* time_env = getenv("MCTS_TIME_MS");
+    double time_limit = (time_env != NULL ? atoi(time_env) : MCTS_TIME_MS) / 1000.0;
+    use_puct = getenv("MCTS_PUCT") != NULL && atoi(getenv("MCTS_PUCT")) != 0;
+    const char* threads_env = getenv("MCTS_THREADS");
+    int num_threads = (threads_env != NULL) ? atoi(threads_env) : MCTS_THREADS;
+    if (num_threads < 1) num_threads = 1;
+    if (num_threads > MAX_THREADS) num_threads = MAX_THREADS;
+    const char* parallel_env = getenv("MCTS_PARALLEL");
+    int root_parallel = (parallel_env != NULL && strcmp(parallel_env, "root") == 0);
+    uint64_t seed = (uint64_t)time(NULL) * 0x2545F4914F6CDD1DULL ^ (uint64_t)getpid();
+
+    if (arena_init(MCTS_ARENA_NODES) != 0) {
+        fprintf(stderr, "Error: Failed to allocate the node arena\n");
+        return EXIT_FAILURE;
+    }
+
+    // Tree parallelism: every thread searches the same root.
+    // Root parallelism: every thread grows its own tree; their root children are merged below.
+    SearchThread threads[MAX_THREADS];
+    pthread_t handles[MAX_THREADS];
+    Node* shared_root = &arena.nodes[new_root()];
+    Position expanded_pos = root_pos;
+    expand(shared_root, &expanded_pos);
+    double search_start = now_seconds();
+    for (int t = 0; t < num_threads; t++) {
+        threads[t].root = shared_root;
+        if (root_parallel && t > 0) {
+            threads[t].root = &arena.nodes[new_root()];
+            expand(threads[t].root, &expanded_pos);
+        }
+        threads[t].root_pos = &root_pos;
+        threads[t].deadline = start + time_limit;
+        threads[t].seed = seed + 0x9E3779B97F4A7C15ULL * (t + 1);
+        threads[t].playouts = 0;
+    }
+    int started = 0;
+    for (int t = 1; t < num_threads; t++) {
+        if (pthread_create(&handles[t], NULL, search_thread, &threads[t]) != 0) break;
+        started = t;
+    }
+    search_thread(&threads[0]);
+    for (int t = 1; t <= started; t++) {
+        pthread_join(handles[t], NULL);
+    }
+    double elapsed = now_seconds() - search_start;
+
+    // Merge visit counts per move (one tree in tree mode, one per thread in root mode)
+    uint64_t visits[COLS] = { 0 }, score[COLS] = { 0 };
+    int win_move = -1;
+    uint64_t playouts = 0;
+    for (int t = 0; t <= started; t++) {
+        playouts += threads[t].playouts;
+        if (t > 0 && threads[t].root == shared_root) continue;
+        Node* root = threads[t].root;
+        Node* children = &arena.nodes[atomic_load(&root->first_child)];
+        for (int i = 0; i < root->num_children; i++) {
+            visits[children[i].move] += atomic_load(&children[i].visits);
+            score[children[i].move] += atomic_load(&children[i].score);
+            if (children[i].terminal == NODE_WIN && win_move < 0) win_move = children[i].move;
+        }
+    }
+
+    // The most visited move is the most reliable one; a winning move is always taken
+    int best = -1;
+    for (int col = 0; col < COLS; col++) {
+        if (!(playable_cells(root_pos.mask) & column_mask(col))) continue;
+        if (best < 0 || visits[col] > visits[best]) best = col;
+    }
+    if (win_move >= 0) best = win_move;
+
+    fprintf(stderr, "mcts: %llu playouts in %.2fs (%.0f playouts/s), %d %s threads, %u nodes, best %c %.3f\n",
+            (unsigned long long)playouts, elapsed, playouts / elapsed, started + 1,
+            root_parallel ? "root" : "tree", atomic_load(&arena.used),
+            stack_name(best), visits[best] ? score[best] / (2.0 * visits[best]) : 0.0);
+    printf("%c", stack_name(best));
+    fflush(stdout);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,80 @@
+// Move generation and win detection benchmark for agent_200
+/*
+ * Counts the positions reachable in exactly N plies from the empty board, using the
+ * engine's own get_valid_moves, apply_move and check_winner. Won positions are counted
+ * but not expanded. Every depth is checked against known counts and timed, so this is
+ * both a benchmark and a regression test for changes to the board representation.
+ *
+ * Usage: ./perft [-d depth]
+ */
+
+#define AGENT_200_NO_MAIN
+#include "agent_200.c"
+
+#include <getopt.h>
+
+// Positions after exactly N plies with finished games not expanded
+static const uint64_t perft_reference[] = {
+    1ULL, 7ULL, 49ULL, 343ULL, 2401ULL, 16807ULL, 117649ULL,
+    823536ULL, 5673234ULL, 39394572ULL, 268031646ULL,
+};
+#define PERFT_KNOWN_DEPTH ((int)(sizeof(perft_reference) / sizeof(perft_reference[0])) - 1)
+
+static uint64_t perft(const State* s, int depth) {
+    if (depth == 0) return 1;
+    int moves[COLS];
+    int num_moves = get_valid_moves(s, moves);
+    if (depth == 1) return num_moves;
+    uint64_t nodes = 0;
+    for (int i = 0; i < num_moves; i++) {
+        State child;
+        copy_state(s, &child);
+        apply_move(&child, moves[i]);
+        if (check_winner(&child) != 0) continue;    // Game over: counted one ply up only
+        nodes += perft(&child, depth - 1);
+    }
+    return nodes;
+}
+
+int main(int argc, char* argv[]) {
+    int max_depth = 8;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:")) != -1) {
+        switch (opt) {
+            case 'd': max_depth = atoi(optarg); break;
+            default:
+                fprintf(stderr, "Usage: %s [-d depth]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (max_depth < 0) {
+        fprintf(stderr, "Error: invalid depth\n");
+        return EXIT_FAILURE;
+    }
+
+    // Empty board, player 1 to move
+    State root;
+    memset(&root, 0, sizeof(root));
+    root.player = 1;
+    sync_bitboards(&root);
+
+    int failures = 0;
+    for (int depth = 0; depth <= max_depth; depth++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t nodes = perft(&root, depth);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        const char* verdict = "unknown";
+        if (depth <= PERFT_KNOWN_DEPTH) {
+            verdict = (nodes == perft_reference[depth]) ? "ok" : "MISMATCH";
+            if (nodes != perft_reference[depth]) failures++;
+        }
+        printf("perft %2d: %12llu nodes  %8.3f s  %12.0f nodes/s  %s\n", depth,
+               (unsigned long long)nodes, seconds, seconds > 0 ? nodes / seconds : 0.0, verdict);
+        fflush(stdout);
+    }
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
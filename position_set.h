@@ -0,0 +1,78 @@
+// Canonical position sets for the offline tools (book_gen, solve_db)
+/*
+ * Include after agent_200.c. Positions are kept in their canonical (mirror-merged)
+ * orientation next to their key, so a level of the game tree can be sorted and
+ * deduplicated with qsort.
+ */
+
+#ifndef POSITION_SET_H
+#define POSITION_SET_H
+
+typedef struct {
+    uint64_t key;
+    Position pos;
+} PositionNode;
+
+static int compare_nodes(const void* a, const void* b) {
+    uint64_t x = ((const PositionNode*)a)->key, y = ((const PositionNode*)b)->key;
+    return (x > y) - (x < y);
+}
+
+// Store p in its canonical orientation
+static PositionNode make_node(const Position* p) {
+    PositionNode n;
+    int mirrored;
+    n.key = canonical_key(position_key(p), &mirrored);
+    n.pos = *p;
+    if (mirrored) {
+        n.pos.current = mirror_key(p->current);
+        n.pos.mask = mirror_key(p->mask);
+    }
+    return n;
+}
+
+// Sort by key and drop duplicates; returns the new count
+static size_t unique_nodes(PositionNode* nodes, size_t count) {
+    if (count == 0) return 0;
+    qsort(nodes, count, sizeof(PositionNode), compare_nodes);
+    size_t n = 1;
+    for (size_t i = 1; i < count; i++) {
+        if (nodes[i].key != nodes[n - 1].key) nodes[n++] = nodes[i];
+    }
+    return n;
+}
+
+// Store every non-terminal child of the level's positions in *next; returns the count
+static size_t expand_level(const PositionNode* level, size_t count, PositionNode** next) {
+    *next = malloc((count * COLS + 1) * sizeof(PositionNode));
+    if (*next == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < count; i++) {
+        const Position* p = &level[i].pos;
+        if (p->moves >= BOARD_CELLS) continue;
+        uint64_t possible = playable_cells(p->mask);
+        uint64_t win = winning_cells(p->current, p->mask);
+        for (int col = 0; col < COLS; col++) {
+            uint64_t move = possible & column_mask(col);
+            if (!move || (move & win)) continue;    // Full column, or the game ends here
+            Position child = *p;
+            position_play(&child, move);
+            (*next)[n++] = make_node(&child);
+        }
+    }
+    return unique_nodes(*next, n);
+}
+
+// Replace *level with the next ply; returns the new count
+static inline size_t advance_level(PositionNode** level, size_t count) {
+    PositionNode* next;
+    size_t n = expand_level(*level, count, &next);
+    free(*level);
+    *level = next;
+    return n;
+}
+
+#endif
@@ -0,0 +1,72 @@
+// Rollout engine for Monte Carlo agents
+/*
+ * Bitboard playouts with a per-thread xorshift generator: no libc rand() lock and no
+ * system call per random number. A playout wins immediately when it can, blocks the
+ * opponent's immediate win when it has to, and otherwise plays a uniformly random column.
+ * Everything is static inline, so including agents only pay for what they use.
+ */
+
+#ifndef ROLLOUT_H
+#define ROLLOUT_H
+
+#include "bitboard.h"
+
+// -------------------------
+// Random Numbers
+// -------------------------
+// xorshift64: one state word per thread, seeded once with rng_seed()
+static _Thread_local uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static inline void rng_seed(uint64_t seed) {
+    // splitmix64 step, so nearby seeds (thread numbers, pids) give unrelated streams
+    seed += 0x9E3779B97F4A7C15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+    seed ^= seed >> 31;
+    rng_state = seed ? seed : 0x9E3779B97F4A7C15ULL;
+}
+
+static inline uint64_t rng_next(void) {
+    uint64_t x = rng_state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return rng_state = x;
+}
+
+// Uniform number in [0, n) without a division
+static inline uint32_t rng_below(uint32_t n) {
+    return (uint32_t)(((rng_next() >> 32) * (uint64_t)n) >> 32);
+}
+
+// One set bit of cells chosen uniformly at random (cells must not be 0)
+static inline uint64_t random_cell(uint64_t cells) {
+    for (uint32_t k = rng_below(__builtin_popcountll(cells)); k > 0; k--) {
+        cells &= cells - 1;
+    }
+    return cells & -cells;
+}
+
+// -------------------------
+// Playouts
+// -------------------------
+// Play p to the end. Returns the result for the player to move at p: 2 = win, 1 = draw, 0 = loss.
+static inline int rollout(Position p) {
+    int side = 0;   // 0 while the original player is to move
+    uint64_t opponent = p.current ^ p.mask;
+    while (p.moves < BOARD_CELLS) {
+        uint64_t possible = playable_cells(p.mask);
+        if (winning_cells(p.current, p.mask) & possible) {
+            return side == 0 ? 2 : 0;
+        }
+        // Block an immediate loss; with two threats the opponent wins on the next move
+        uint64_t forced = winning_cells(opponent, p.mask) & possible;
+        uint64_t move = random_cell(forced ? forced : possible);
+        opponent = p.current | move;
+        position_play(&p, move);
+        side ^= 1;
+    }
+    return 1;
+}
+
+#endif
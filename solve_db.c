@@ -0,0 +1,115 @@
+// Solved-position database builder for agent_200
+/*
+ * Solves every position of plies [first, last] exactly (mirror images merged) and writes
+ * their win/draw/loss values as a sorted table that agent_200 maps read-only.
+ * Positions are shared out to worker threads, each with its own solver table.
+ * Expect hours for ply 8 and more for deeper plies; the table is built once, offline.
+ *
+ * Usage: ./solve_db [-f first-ply] [-l last-ply] [-t threads] [-o output]
+ */
+
+#define AGENT_200_NO_MAIN
+#include "agent_200.c"
+#include "position_set.h"
+
+#include <getopt.h>
+
+// Work shared by the solving threads: one ply of positions
+typedef struct {
+    const PositionNode* nodes;
+    size_t count;
+    atomic_size_t next;     // Index of the next position to hand out
+    atomic_size_t done;
+    uint64_t* entries;      // Output, one entry per position
+} SolveJob;
+
+static void* solve_worker(void* arg) {
+    SolveJob* job = (SolveJob*)arg;
+    if (solver_init() != 0) {
+        fprintf(stderr, "Error: failed to allocate solver table\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->count) {
+        const Position* p = &job->nodes[i].pos;
+        solver_mirror = position_symmetric(p);
+        int wdl = (p->moves == BOARD_CELLS) ? 0 : solver_wdl(p);
+        job->entries[i] = (job->nodes[i].key << 8) | (uint64_t)(wdl + 2);
+        size_t done = atomic_fetch_add(&job->done, 1) + 1;
+        if (done % 10000 == 0) {
+            fprintf(stderr, "  %zu / %zu\n", done, job->count);
+        }
+    }
+    solver_free();          // Every ply starts a new pool of threads
+    return NULL;
+}
+
+int main(int argc, char* argv[]) {
+    int first = 8, last = 8;
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* output = WDL_DB_FILE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "f:l:t:o:")) != -1) {
+        switch (opt) {
+            case 'f': first = atoi(optarg); break;
+            case 'l': last = atoi(optarg); break;
+            case 't': threads = atoi(optarg); break;
+            case 'o': output = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-f first-ply] [-l last-ply] [-t threads] [-o output]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (first < 0 || last < first || last > WDL_DB_MAX_PLY || threads < 1) {
+        fprintf(stderr, "Error: need 0 <= first <= last <= %d and at least one thread\n", WDL_DB_MAX_PLY);
+        return EXIT_FAILURE;
+    }
+
+    uint64_t* entries = NULL;
+    size_t num_entries = 0;
+    Position empty = { 0, 0, 0 };
+    PositionNode* level = malloc(sizeof(PositionNode));
+    level[0] = make_node(&empty);
+    size_t count = 1;
+
+    for (int ply = 0; ply <= last && count > 0; ply++) {
+        if (ply >= first) {
+            fprintf(stderr, "ply %d: solving %zu positions\n", ply, count);
+            entries = realloc(entries, (num_entries + count) * sizeof(uint64_t));
+            if (entries == NULL) {
+                fprintf(stderr, "Error: out of memory\n");
+                return EXIT_FAILURE;
+            }
+            SolveJob job;
+            job.nodes = level;
+            job.count = count;
+            atomic_init(&job.next, 0);
+            atomic_init(&job.done, 0);
+            job.entries = entries + num_entries;
+
+            pthread_t* workers = malloc(threads * sizeof(pthread_t));
+            int started = 0;
+            for (int t = 1; t < threads; t++) {
+                if (pthread_create(&workers[started], NULL, solve_worker, &job) != 0) break;
+                started++;
+            }
+            solve_worker(&job);
+            for (int t = 0; t < started; t++) {
+                pthread_join(workers[t], NULL);
+            }
+            free(workers);
+            num_entries += count;
+        }
+        if (ply < last) count = advance_level(&level, count);
+    }
+    free(level);
+
+    if (table_write(output, WDL_DB_MAGIC, entries, num_entries) != 0) {
+        perror("Error: failed to write database");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Wrote %zu entries to %s\n", num_entries, output);
+    free(entries);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,293 @@
+// Endgame tablebase builder for agent_200
+/*
+ * Enumerates every position reachable from the seed positions (read in the referee's
+ * format from a file or stdin) that has at most K empty cells, and optionally the given
+ * columns full, then solves them backward: positions with the most stones first, each one
+ * from the values of its children, which are always part of the set. The win/draw/loss
+ * values are written with a perfect hash (see "Endgame Tablebase" in agent_200.c), so the
+ * agent looks a position up in constant time.
+ *
+ * All positions with 12 empty cells are far too many to enumerate, so the seeds decide what
+ * is covered, e.g. the positions of recorded games or of an evaluation suite. Positions
+ * between a seed and the window are expanded but not stored.
+ *
+ * Usage: ./tablebase [-k empty] [-c columns] [-t threads] [-o output] [seeds]
+ */
+
+#define AGENT_200_NO_MAIN
+#include "agent_200.c"
+#include "position_set.h"
+
+#include <getopt.h>
+
+#define TB_BUCKET_SIZE 4        // Average keys per displacement
+#define TB_LOAD_PERCENT 98      // Stored positions per 100 slots
+
+// Work shared by the solving threads: one ply of positions, whose children are solved
+typedef struct {
+    const PositionNode* nodes;
+    size_t count;
+    int8_t* values;
+    const PositionNode* children;   // The next ply, sorted by key
+    size_t num_children;
+    const int8_t* child_values;
+    atomic_size_t next;
+} SolveJob;
+
+static int child_value(const SolveJob* job, const Position* child) {
+    if (child->moves == BOARD_CELLS) return 0;
+    PositionNode key = make_node(child);
+    const PositionNode* found = bsearch(&key, job->children, job->num_children, sizeof(PositionNode), compare_nodes);
+    if (found == NULL) {
+        fprintf(stderr, "Error: child position missing from the next ply\n");
+        exit(EXIT_FAILURE);
+    }
+    return job->child_values[found - job->children];
+}
+
+// Positions are not finished (expand_level leaves out won ones): the player to move wins at
+// once if possible, otherwise takes the best of its children.
+static void* solve_worker(void* arg) {
+    SolveJob* job = (SolveJob*)arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->count) {
+        const Position* p = &job->nodes[i].pos;
+        uint64_t possible = playable_cells(p->mask);
+        if (winning_cells(p->current, p->mask) & possible) {
+            job->values[i] = 1;
+            continue;
+        }
+        int best = -1;
+        for (int col = 0; col < COLS && best < 1; col++) {
+            uint64_t move = possible & column_mask(col);
+            if (!move) continue;
+            Position child = *p;
+            position_play(&child, move);
+            int value = -child_value(job, &child);
+            if (value > best) best = value;
+        }
+        job->values[i] = (int8_t)best;
+    }
+    return NULL;
+}
+
+static void solve_level(SolveJob* job, int threads) {
+    atomic_init(&job->next, 0);
+    pthread_t* workers = malloc(threads * sizeof(pthread_t));
+    int started = 0;
+    for (int t = 1; t < threads; t++) {
+        if (pthread_create(&workers[started], NULL, solve_worker, job) != 0) break;
+        started++;
+    }
+    solve_worker(job);
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+}
+
+// Place entries (key << 8 | payload) with a hash-and-displace perfect hash and write the
+// file; returns 0 on success.
+static int tb_write(const char* path, const uint64_t* entries, uint64_t count, int min_moves) {
+    uint64_t num_buckets = count / TB_BUCKET_SIZE + 1;
+    uint64_t num_slots = count * 100 / TB_LOAD_PERCENT + 1;
+    uint32_t* displacements = calloc(num_buckets, sizeof(uint32_t));
+    uint64_t* slots = calloc(num_slots, sizeof(uint64_t));
+    uint64_t* bucket_start = calloc(num_buckets + 1, sizeof(uint64_t));
+    uint64_t* by_bucket = malloc((count + 1) * sizeof(uint64_t));
+    uint64_t* order = malloc((num_buckets + 1) * sizeof(uint64_t));
+    if (!displacements || !slots || !bucket_start || !by_bucket || !order) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Group the entries by bucket (counting sort)
+    for (uint64_t i = 0; i < count; i++) bucket_start[tb_bucket(entries[i] >> 8, num_buckets) + 1]++;
+    for (uint64_t b = 0; b < num_buckets; b++) bucket_start[b + 1] += bucket_start[b];
+    uint64_t* fill = malloc((num_buckets + 1) * sizeof(uint64_t));
+    memcpy(fill, bucket_start, (num_buckets + 1) * sizeof(uint64_t));
+    for (uint64_t i = 0; i < count; i++) by_bucket[fill[tb_bucket(entries[i] >> 8, num_buckets)]++] = entries[i];
+    free(fill);
+
+    // Largest buckets first, while most slots are still free: a counting sort by size
+    uint64_t max_size = 0;
+    for (uint64_t b = 0; b < num_buckets; b++) {
+        uint64_t size = bucket_start[b + 1] - bucket_start[b];
+        if (size > max_size) max_size = size;
+    }
+    uint64_t* placed = malloc((max_size + 1) * sizeof(uint64_t));
+    if (placed == NULL) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    uint64_t n = 0;
+    for (uint64_t size = max_size; size > 0; size--) {
+        for (uint64_t b = 0; b < num_buckets; b++) {
+            if (bucket_start[b + 1] - bucket_start[b] == size) order[n++] = b;
+        }
+    }
+
+    for (uint64_t k = 0; k < n; k++) {
+        uint64_t b = order[k];
+        const uint64_t* keys = by_bucket + bucket_start[b];
+        uint64_t size = bucket_start[b + 1] - bucket_start[b];
+        for (uint32_t d = 0; ; d++) {
+            if (d == UINT32_MAX) {
+                fprintf(stderr, "Error: no perfect hash found\n");
+                exit(EXIT_FAILURE);
+            }
+            uint64_t j;
+            for (j = 0; j < size; j++) {
+                uint64_t slot = tb_slot(keys[j] >> 8, d, num_slots);
+                if (slots[slot] != 0) break;
+                uint64_t m;
+                for (m = 0; m < j && placed[m] != slot; m++) {
+                }
+                if (m < j) break;
+                placed[j] = slot;
+            }
+            if (j < size) continue;
+            for (j = 0; j < size; j++) slots[placed[j]] = keys[j];
+            displacements[b] = d;
+            break;
+        }
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) return -1;
+    char magic[8] = { 0 };
+    memcpy(magic, TB_MAGIC, strlen(TB_MAGIC));
+    uint64_t header[3] = { num_slots, num_buckets, (uint64_t)min_moves };
+    uint64_t padding = 0;
+    size_t pad = ((num_buckets * sizeof(uint32_t) + 7) & ~7ULL) - num_buckets * sizeof(uint32_t);
+    int ok = fwrite(magic, 1, 8, f) == 8 && fwrite(header, sizeof(uint64_t), 3, f) == 3 &&
+             fwrite(displacements, sizeof(uint32_t), num_buckets, f) == num_buckets &&
+             fwrite(&padding, 1, pad, f) == pad &&
+             fwrite(slots, sizeof(uint64_t), num_slots, f) == num_slots;
+    free(displacements);
+    free(slots);
+    free(bucket_start);
+    free(by_bucket);
+    free(order);
+    free(placed);
+    return (fclose(f) == 0 && ok) ? 0 : -1;
+}
+
+int main(int argc, char* argv[]) {
+    int max_empty = 12;
+    uint64_t full_columns = 0;      // Cells of the columns that must be full
+    int threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    const char* output = TB_FILE;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "k:c:t:o:")) != -1) {
+        switch (opt) {
+            case 'k': max_empty = atoi(optarg); break;
+            case 'c':
+                for (const char* c = optarg; *c; c++) {
+                    if (*c >= 'A' && *c < 'A' + COLS) full_columns |= column_mask(*c - 'A');
+                }
+                break;
+            case 't': threads = atoi(optarg); break;
+            case 'o': output = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-k empty] [-c columns] [-t threads] [-o output] [seeds]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if (max_empty < 0 || max_empty > BOARD_CELLS || threads < 1) {
+        fprintf(stderr, "Error: need 0 <= empty <= %d and at least one thread\n", BOARD_CELLS);
+        return EXIT_FAILURE;
+    }
+    FILE* in = stdin;
+    if (optind < argc) {
+        in = fopen(argv[optind], "r");
+        if (in == NULL) {
+            fprintf(stderr, "Error: cannot open %s\n", argv[optind]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Seeds by ply; finished games are of no use
+    PositionNode* seeds[BOARD_CELLS + 1] = { NULL };
+    size_t num_seeds[BOARD_CELLS + 1] = { 0 };
+    State s;
+    int status;
+    while ((status = read_position(in, &s)) > 0) {
+        if (check_winner(&s) != 0) continue;
+        Position p = { s.stones[s.player], s.mask, s.moves };
+        seeds[p.moves] = realloc(seeds[p.moves], (num_seeds[p.moves] + 1) * sizeof(PositionNode));
+        seeds[p.moves][num_seeds[p.moves]++] = make_node(&p);
+    }
+    if (status < 0) return EXIT_FAILURE;
+    if (in != stdin) fclose(in);
+
+    // Forward: every ply of reachable positions; those inside the window are kept
+    int first_ply = BOARD_CELLS - max_empty;
+    PositionNode* levels[BOARD_CELLS + 1] = { NULL };
+    size_t counts[BOARD_CELLS + 1] = { 0 };
+    PositionNode* level = NULL;
+    size_t count = 0;
+    for (int ply = 0; ply < BOARD_CELLS; ply++) {
+        if (num_seeds[ply] > 0) {
+            level = realloc(level, (count + num_seeds[ply]) * sizeof(PositionNode));
+            memcpy(level + count, seeds[ply], num_seeds[ply] * sizeof(PositionNode));
+            count = unique_nodes(level, count + num_seeds[ply]);
+            free(seeds[ply]);
+        }
+        if (count == 0) continue;
+        PositionNode* next;
+        size_t next_count = expand_level(level, count, &next);
+        if (ply >= first_ply) {
+            // Keep the positions with the required columns full (children keep them full)
+            size_t kept = 0;
+            for (size_t i = 0; i < count; i++) {
+                if ((level[i].pos.mask & full_columns) == full_columns) level[kept++] = level[i];
+            }
+            levels[ply] = level;
+            counts[ply] = kept;
+            fprintf(stderr, "ply %d: %zu positions\n", ply, kept);
+        } else {
+            free(level);
+        }
+        level = next;
+        count = next_count;
+    }
+    free(level);    // Full boards: draws, never looked up
+
+    // Backward: each ply from the values of the next one
+    int8_t* values[BOARD_CELLS + 1] = { NULL };
+    uint64_t* entries = NULL;
+    size_t num_entries = 0;
+    int min_moves = BOARD_CELLS;
+    for (int ply = BOARD_CELLS - 1; ply >= first_ply && ply >= 0; ply--) {
+        if (counts[ply] == 0) continue;
+        values[ply] = malloc(counts[ply]);
+        SolveJob job = {
+            .nodes = levels[ply], .count = counts[ply], .values = values[ply],
+            .children = levels[ply + 1], .num_children = counts[ply + 1], .child_values = values[ply + 1],
+        };     // next is set by solve_level
+        solve_level(&job, threads);
+        entries = realloc(entries, (num_entries + counts[ply]) * sizeof(uint64_t));
+        if (entries == NULL) {
+            fprintf(stderr, "Error: out of memory\n");
+            return EXIT_FAILURE;
+        }
+        for (size_t i = 0; i < counts[ply]; i++) {
+            entries[num_entries++] = (levels[ply][i].key << 8) | (uint64_t)(values[ply][i] + 2);
+        }
+        min_moves = ply;
+    }
+    for (int ply = 0; ply <= BOARD_CELLS; ply++) {
+        free(levels[ply]);
+        free(values[ply]);
+    }
+
+    if (tb_write(output, entries, num_entries, min_moves) != 0) {
+        perror("Error: failed to write tablebase");
+        return EXIT_FAILURE;
+    }
+    fprintf(stderr, "Wrote %zu positions to %s\n", num_entries, output);
+    free(entries);
+    return EXIT_SUCCESS;
+}
@@ -15,6 +15,8 @@
 // Define constants and Variables
 #define COLS 7
 #define ROWS 6
+#include "rollout.h" // Shared xorshift generator (and bitboard.h)
+#include "greedy_agent.h" // Anytime fallback and threat filter
 
 static int this_player;
 static int board[ROWS][COLS]; // Use index 0 to ROWS-1, 0 to COLS-1
@@ -30,26 +32,24 @@ char stack_name(int i) {
     return 'A' + i;
 }
 
-// Function to get a random number using /dev/urandom
+// Function to get a random number: /dev/urandom is only read once, to seed the xorshift generator
 int get_random_int(int min, int max) {
-    int fd = open("/dev/urandom", O_RDONLY);
-    if (fd < 0) {
-        fprintf(stderr, "Error: Failed to open /dev/urandom\n");
-        return -1; // Fallback to a default value if needed
-    }
-
-    unsigned int random_value;
-    ssize_t result = read(fd, &random_value, sizeof(random_value));
-    if (result < 0) {
-        fprintf(stderr, "Error: Failed to read from /dev/urandom\n");
-        close(fd);
-        return -1;
+    static int seeded = 0;
+    if (!seeded) {
+        uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+        int fd = open("/dev/urandom", O_RDONLY);
+        if (fd >= 0) {
+            if (read(fd, &seed, sizeof(seed)) != sizeof(seed)) {
+                fprintf(stderr, "Warning: Failed to read from /dev/urandom, seeding from time\n");
+            }
+            close(fd);
+        }
+        rng_seed(seed);
+        seeded = 1;
     }
 
-    close(fd);
-
     // Scale the random value to the desired range [min, max]
-    return min + (random_value % (max - min + 1));
+    return min + (int)rng_below(max - min + 1);
 }
 
 // Count stones in a direction
@@ -75,7 +75,7 @@ int count_left(int stack, int level, int player) {
     return count_adjacent_stones(stack + LEFTWARD, level, LEFTWARD, 0, player);
 }
 
-[Oint count_right(int stack, int level, int player) {
+int count_right(int stack, int level, int player) {
     return count_adjacent_stones(stack + RIGHTWARD, level, RIGHTWARD, 0, player);
 }
 
@@ -122,6 +122,7 @@ int find_blocking_move(int player) {
 
 // Evaluate a move by calculating a score (aggressive strategy)
 int evaluate_move(int stack, int player, int other_player) {
+    (void)other_player; // Unused: the aggressive strategy has no defense score
     if (top[stack] >= ROWS) return -1; // Invalid move
 
     int level = top[stack];
@@ -159,6 +160,20 @@ int evaluate_move(int stack, int player, int other_player) {
     return score;
 }
 
+// Bitboard copy of the board (see bitboard.h): stones of player and all stones
+void board_bitboards(int player, uint64_t* stones, uint64_t* mask) {
+    *stones = 0;
+    *mask = 0;
+    for (int i = 0; i < ROWS; i++) {
+        for (int j = 0; j < COLS; j++) {
+            if (board[i][j] == 0) continue;
+            uint64_t bit = CELL_BIT(ROWS - 1 - i, j);
+            *mask |= bit;
+            if (board[i][j] == player) *stones |= bit;
+        }
+    }
+}
+
 int main() {
     // Read player number
     if (scanf("%d", &this_player) != 1) {
@@ -194,17 +209,23 @@ int main() {
         }
     }
 
+    // Arm the fallback, then filter moves through the threat masks (see greedy_agent.h)
+    uint64_t stones, mask;
+    board_bitboards(this_player, &stones, &mask);
+    start_timer(mask);
+    Threats threats = threats_of(stones, mask);
+
     // Find winning move
-    int choice = find_winning_move(this_player);
+    int choice = threat_win_column(&threats, find_winning_move(this_player));
     if (choice >= 0) {
-        printf("%c", stack_name(choice));
+        write_move(choice);
         return EXIT_SUCCESS;
     }
 
     // Minimal defense: Only block opponent's immediate win
     choice = find_blocking_move(this_player);
-    if (choice >= 0) {
-        printf("%c", stack_name(choice));
+    if (choice >= 0 && threat_allows(&threats, choice)) {
+        write_move(choice);
         return EXIT_SUCCESS;
     }
 
@@ -216,6 +237,7 @@ int main() {
     int equal_score_count = 0;
 
     for (int stack = 0; stack < COLS; stack++) {
+        if (!threat_allows(&threats, stack)) continue;
         int score = evaluate_move(stack, this_player, other_player);
         if (score > best_score) {
             best_score = score;
@@ -254,7 +276,7 @@ int main() {
                 }
             }
         }
-        printf("%c", stack_name(best_stack));
+        write_move(best_stack);
     } else {
         fprintf(stderr, "Error: No valid move found\n");
         return EXIT_FAILURE;
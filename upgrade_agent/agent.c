@@ -10,6 +10,7 @@
 // Define constants and Variables
 #define COLS 7
 #define ROWS 6
+#include "../greedy_agent.h" // Anytime fallback and threat filter (with bitboard.h)
 
 static int this_player;
 static int board[ROWS][COLS]; // Use index 0 to ROWS-1, 0 to COLS-1
@@ -145,6 +146,20 @@ int evaluate_move(int stack, int player, int other_player) {
     return score;
 }
 
+// Bitboard copy of the board (see bitboard.h): stones of player and all stones
+void board_bitboards(int player, uint64_t* stones, uint64_t* mask) {
+    *stones = 0;
+    *mask = 0;
+    for (int i = 0; i < ROWS; i++) {
+        for (int j = 0; j < COLS; j++) {
+            if (board[i][j] == 0) continue;
+            uint64_t bit = CELL_BIT(i, j);
+            *mask |= bit;
+            if (board[i][j] == player) *stones |= bit;
+        }
+    }
+}
+
 int main() {
     // Read player number
     if (scanf("%d", &this_player) != 1) {
@@ -176,17 +191,23 @@ int main() {
         }
     }
 
+    // Arm the fallback, then filter moves through the threat masks (see greedy_agent.h)
+    uint64_t stones, mask;
+    board_bitboards(this_player, &stones, &mask);
+    start_timer(mask);
+    Threats threats = threats_of(stones, mask);
+
     // Find winning move
-    int choice = find_winning_move(this_player);
+    int choice = threat_win_column(&threats, find_winning_move(this_player));
     if (choice >= 0) {
-        printf("%c", 'A' + choice);
+        write_move(choice);
         return EXIT_SUCCESS;
     }
 
     // Find blocking move
     choice = find_blocking_move(this_player);
-    if (choice >= 0) {
-        printf("%c", 'A' + choice);
+    if (choice >= 0 && threat_allows(&threats, choice)) {
+        write_move(choice);
         return EXIT_SUCCESS;
     }
 
@@ -196,6 +217,7 @@ int main() {
     int best_stack = -1;
 
     for (int stack = 0; stack < COLS; stack++) {
+        if (!threat_allows(&threats, stack)) continue;
         int score = evaluate_move(stack, this_player, other_player);
         if (score > best_score) {
             best_score = score;
@@ -209,7 +231,7 @@ int main() {
     }
 
     if (best_stack >= 0) {
-        printf("%c", 'A' + best_stack);
+        write_move(best_stack);
     } else {
         // Fallback: should not happen, but just in case
         fprintf(stderr, "Error: No valid move found\n");